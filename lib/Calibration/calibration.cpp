@@ -0,0 +1,279 @@
+#include "calibration.hpp"
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
+
+CalibrationData calibration;
+
+// Candidate system clocks (kHz) and input SPI speeds (Hz), slowest first
+const uint32_t calibration_clocks[] = {125000, 133000, 150000, 175000, 200000};
+const uint32_t calibration_speeds[] = {10000000, 15000000, 20000000, 25000000, 31250000, 41666666, 62500000};
+const uint8_t calibration_clock_count = sizeof(calibration_clocks) / sizeof(calibration_clocks[0]);
+const uint8_t calibration_speed_count = sizeof(calibration_speeds) / sizeof(calibration_speeds[0]);
+
+CalibrationStep calibration_steps[CALIBRATION_MAX_STEPS];
+uint8_t calibration_step_count = 0;
+bool calibration_ran = false;
+
+/**
+ * Compute the checksum of the calibration data.
+ * 
+ * @param data the calibration data
+ * @return the checksum
+ */
+uint32_t calibrationChecksum(const CalibrationData &data) {
+    return ~(data.magic ^ data.version ^ data.sys_clock_khz ^ data.spi_speed_inputs ^ data.spi_speed_outputs);
+}
+
+/**
+ * Load the calibration saved in flash.
+ * 
+ * @return whether a valid calibration was found
+ */
+bool loadCalibration() {
+    CalibrationData data;
+    EEPROM.begin(CALIBRATION_EEPROM_SIZE);
+    EEPROM.get(CALIBRATION_ADDRESS, data);
+    EEPROM.end();
+
+    if (data.magic != CALIBRATION_MAGIC || data.version != CALIBRATION_VERSION) return false;
+    if (data.checksum != calibrationChecksum(data)) return false;
+
+    calibration = data;
+    return true;
+}
+
+/**
+ * Save the current calibration to flash.  This pauses the other core while
+ * the flash is written, so it can't be used once core 0 is isolated.
+ */
+void saveCalibration() {
+    calibration.magic = CALIBRATION_MAGIC;
+    calibration.version = CALIBRATION_VERSION;
+    calibration.checksum = calibrationChecksum(calibration);
+
+    EEPROM.begin(CALIBRATION_EEPROM_SIZE);
+    EEPROM.put(CALIBRATION_ADDRESS, calibration);
+    EEPROM.commit();
+    EEPROM.end();
+}
+
+/**
+ * Take over SPI0 from the Arduino library so it can be driven directly.
+ */
+void beginCalibrationBus() {
+    spi_init(spi0, CALIBRATION_REFERENCE_SPEED);
+}
+
+/**
+ * Hand SPI0 back to the Arduino library.  Restarting it makes sure it
+ * picks up the current clocks the next time it's used.
+ */
+void endCalibrationBus() {
+    SPI.end();
+    SPI.begin();
+}
+
+/**
+ * Apply the current calibration to the system clock and the SPI settings,
+ * restarting SPI0 so it picks up the new clocks.  This needs to happen
+ * before anything else derives its timing from the system clock (UART and
+ * I2C baud rates).
+ */
+void applyCalibration() {
+    if (calibration.sys_clock_khz && !set_sys_clock_khz(calibration.sys_clock_khz, false)) {
+        calibration = CalibrationData();
+    }
+    inputSettings = SPISettings(calibration.spi_speed_inputs, MSBFIRST, SPI_MODE2);
+    outputSettings = SPISettings(calibration.spi_speed_outputs, MSBFIRST, SPI_MODE0);
+    endCalibrationBus();
+}
+
+/**
+ * Latch and read all of the inputs (4 bytes).
+ * 
+ * @param config the SPI configuration to read with
+ * @return the input data
+ */
+uint32_t readLatched(const SpiConfig &config) {
+    uint32_t data;
+
+    applySpiConfig(spi0, config);
+    gpio_put(INPUT_CE, LOW);
+    gpio_put(INPUT_LATCH, LOW);
+    busy_wait_at_least_cycles(8);
+    gpio_put(INPUT_LATCH, HIGH);
+
+    spi_read_blocking(spi0, 0, (uint8_t *)&data, 4);
+
+    gpio_put(INPUT_CE, HIGH);
+    return data;
+}
+
+/**
+ * Capture the configuration for reading the inputs at the reference speed.
+ * 
+ * @return the captured configuration
+ */
+SpiConfig referenceConfig() {
+    return captureSpiConfig(spi0, SPISettings(CALIBRATION_REFERENCE_SPEED, MSBFIRST, SPI_MODE2));
+}
+
+/**
+ * Check whether calibration was requested by holding PE, P- and P+.
+ * 
+ * @return whether to run the calibration
+ */
+bool calibrationRequested() {
+    beginCalibrationBus();
+    const bool requested = (readLatched(referenceConfig()) & CALIBRATION_INPUTS) == CALIBRATION_INPUTS;
+    endCalibrationBus();
+    return requested;
+}
+
+/**
+ * Repeatedly read the inputs with the given configuration and count the
+ * reads that don't match a read at the reference speed.  Holding the
+ * calibration inputs gives a pattern where a bit-shifted read can't match,
+ * so this catches both flipped and shifted bits.  If the inputs change
+ * during the check it's retried.
+ * 
+ * @param step where to store the read time and error count
+ * @param reference the reference configuration
+ * @param config the configuration to check
+ * @return whether the calibration inputs were held for the check
+ */
+bool checkStep(CalibrationStep &step, const SpiConfig &reference, const SpiConfig &config) {
+    for (uint8_t attempt = 0; attempt < CALIBRATION_RETRIES; attempt++) {
+        const uint32_t expected = readLatched(reference);
+        if ((expected & CALIBRATION_INPUTS) != CALIBRATION_INPUTS) return false;
+
+        uint32_t errors = 0;
+        const uint32_t start = time_us_32();
+        for (uint32_t i = 0; i < CALIBRATION_READS; i++) {
+            if (readLatched(config) != expected) errors++;
+        }
+        const uint32_t elapsed = time_us_32() - start;
+
+        if (readLatched(reference) != expected) continue;
+
+        step.errors = errors;
+        step.read_time = (uint64_t)elapsed * 1000 / CALIBRATION_READS;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Step through the candidate system clocks and input SPI speeds, checking
+ * the input reads at each one.  The passing combination with the lowest
+ * measured read time is picked, then backed off one step on both axes
+ * (to the next slower tested clock and the next slower passing speed) for
+ * margin, whether or not anything faster failed: the top of each ladder
+ * has nothing above it to show how close it is to the edge.  The 74HC595s
+ * can't be read back, so the output speed is left at its default.  The
+ * system clock is restored when done; call applyCalibration() to use the
+ * result.
+ * 
+ * @return whether a stable setting was found with the inputs held throughout
+ */
+bool runCalibration() {
+    const uint32_t boot_clock_khz = clock_get_hz(clk_sys) / 1000;
+    // Read time (ns) of every passing step, 0 where it failed or wasn't tested
+    uint32_t read_times[calibration_clock_count][calibration_speed_count] = {};
+    bool tested[calibration_clock_count] = {};
+    bool held = true;
+
+    calibration_ran = true;
+    calibration_step_count = 0;
+    beginCalibrationBus();
+
+    for (uint8_t c = 0; c < calibration_clock_count && held; c++) {
+        if (!set_sys_clock_khz(calibration_clocks[c], false)) continue;
+        tested[c] = true;
+
+        const SpiConfig reference = referenceConfig();
+        uint32_t last_speed = 0;
+        for (uint8_t s = 0; s < calibration_speed_count; s++) {
+            const SpiConfig config = captureSpiConfig(spi0, SPISettings(calibration_speeds[s], MSBFIRST, SPI_MODE2));
+
+            // Speeds get rounded to a divider of the clock, skip duplicates
+            const uint32_t actual_speed = spi_get_baudrate(spi0);
+            if (actual_speed == last_speed) continue;
+            last_speed = actual_speed;
+
+            CalibrationStep step = {calibration_clocks[c], actual_speed, 0, 0};
+            if (!checkStep(step, reference, config)) {
+                held = false;
+                break;
+            }
+            if (calibration_step_count < CALIBRATION_MAX_STEPS) {
+                calibration_steps[calibration_step_count++] = step;
+            }
+
+            if (step.errors) break;
+            read_times[c][s] = max(step.read_time, (uint32_t)1);
+        }
+    }
+
+    set_sys_clock_khz(boot_clock_khz, false);
+    endCalibrationBus();
+    if (!held) return false;
+
+    // Find the passing combination with the lowest read time
+    int8_t best_clock = -1, best_speed = -1;
+    for (uint8_t c = 0; c < calibration_clock_count; c++) {
+        for (uint8_t s = 0; s < calibration_speed_count; s++) {
+            if (!read_times[c][s]) continue;
+            if (best_clock < 0 || read_times[c][s] <= read_times[best_clock][best_speed]) {
+                best_clock = c;
+                best_speed = s;
+            }
+        }
+    }
+    if (best_clock < 0) return false;
+
+    // Back off one step on both axes for margin
+    int8_t margin_clock = best_clock;
+    for (int8_t c = best_clock - 1; c >= 0; c--) {
+        if (tested[c]) {
+            margin_clock = c;
+            break;
+        }
+    }
+    int8_t margin_speed = -1;
+    for (int8_t s = best_speed - 1; s >= 0; s--) {
+        if (read_times[margin_clock][s]) {
+            margin_speed = s;
+            break;
+        }
+    }
+    if (margin_speed < 0 && read_times[margin_clock][best_speed]) margin_speed = best_speed;
+    if (margin_speed < 0) return false;
+
+    calibration.sys_clock_khz = calibration_clocks[margin_clock];
+    calibration.spi_speed_inputs = calibration_speeds[margin_speed];
+    calibration.spi_speed_outputs = SPI0_SCLK_SPEED_OUTPUTS;
+    return true;
+}
+
+/**
+ * Print the clocks in use and, if calibration ran this boot, the result
+ * of every step that was checked.
+ * 
+ * @param out where to print the report
+ */
+void printCalibrationReport(Print &out) {
+    out.printf("Clocks: system %lu kHz, SPI inputs %lu Hz, SPI outputs %lu Hz (%s)\n",
+        clock_get_hz(clk_sys) / 1000, inputSettings.getClockFreq(), outputSettings.getClockFreq(),
+        calibration.magic == CALIBRATION_MAGIC ? "calibrated" : "default");
+
+    if (!calibration_ran) return;
+
+    out.println("Calibration steps:");
+    for (uint8_t i = 0; i < calibration_step_count; i++) {
+        const CalibrationStep &step = calibration_steps[i];
+        out.printf("  %6lu kHz %9lu Hz %6lu ns/read %s (%lu/%d errors)\n",
+            step.sys_clock_khz, step.spi_speed, step.read_time,
+            step.errors ? "FAIL" : "ok  ", step.errors, CALIBRATION_READS);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef _CALIBRATION_HPP
+#define _CALIBRATION_HPP
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <EEPROM.h>
+#include "inputs.hpp"
+#include "isolation.hpp"
+
+#define CALIBRATION_MAGIC   0x43424655 // "UFBC"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_ADDRESS 0
+#define CALIBRATION_EEPROM_SIZE 256
+
+#define CALIBRATION_INPUTS (0b111u << 29)  // PE, P- and P+ held at boot
+#define CALIBRATION_REFERENCE_SPEED 1000000
+#define CALIBRATION_READS   2000
+#define CALIBRATION_RETRIES 3
+#define CALIBRATION_MAX_STEPS 48
+
+
+struct CalibrationData {
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t sys_clock_khz = 0; // 0 leaves the system clock alone
+    uint32_t spi_speed_inputs = SPI0_SCLK_SPEED_INPUTS;
+    uint32_t spi_speed_outputs = SPI0_SCLK_SPEED_OUTPUTS;
+    uint32_t checksum = 0;
+};
+
+struct CalibrationStep {
+    uint32_t sys_clock_khz;
+    uint32_t spi_speed;
+    uint32_t read_time; // nanoseconds per latched read
+    uint32_t errors;
+};
+
+extern CalibrationData calibration;
+
+bool loadCalibration();
+void saveCalibration();
+void applyCalibration();
+bool calibrationRequested();
+bool runCalibration();
+void printCalibrationReport(Print &out);
+
+#endif // _CALIBRATION_HPP
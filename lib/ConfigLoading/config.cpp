@@ -13,9 +13,11 @@ void cleanup() {
  * Loads the profile configuration from the SD card.
  * 
  * @param profiles the profile map to load the profiles into
+ * @param display_config the display configuration to load into
+ * @param governor_config the scan governor configuration to load into
  * @return whether reading the profiles was successful
  */
-bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig &display_config) {
+bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig &display_config, GovernorConfig &governor_config) {
     display_config.address = DISP_DEFAULT_ADDR;
 
     SPI1.setRX(SPI1_MISO);
@@ -23,14 +25,14 @@ bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig
     SPI1.setSCK(SPI1_SCLK);
 
     if (!SD.begin(SDCARD_SS, SPI1)) {
-        Serial.println("SDCard is has either failed or is not present, skipping.");
+        DebugSerial.println("SDCard is has either failed or is not present, skipping.");
         cleanup();
         return true;
     }
 
     File pfile = SD.open("profiles.json");
     if (!pfile) { 
-        Serial.println("Could not open the profiles configuration 'profiles.json', skipping.");
+        DebugSerial.println("Could not open the profiles configuration 'profiles.json', skipping.");
         cleanup();
         return true;
     }
@@ -38,14 +40,14 @@ bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, pfile);
     if (error) {
-        Serial.print(F("Deserializating profile data failed: "));
-        Serial.println(error.f_str());
+        DebugSerial.print(F("Deserializating profile data failed: "));
+        DebugSerial.println(error.f_str());
         pfile.close();
         cleanup();
         return true;
     }
 
-    Serial.println("Loading profiles...");
+    DebugSerial.println("Loading profiles...");
 
     uint8_t default_layout = 0;
     JsonObject dconfig = doc["display"];
@@ -72,10 +74,27 @@ bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig
             display_config.resolution.toLowerCase();
         }
     }
+
+    JsonObject sconfig = doc["scan"];
+    if (sconfig != NULL) {
+        if (sconfig["period_us"].is<uint32_t>()) {
+            governor_config.period = sconfig["period_us"];
+
+            // Anything shorter can't be armed in time, so every scan would overrun
+            if (governor_config.period && governor_config.period < GOVERNOR_MIN_LEAD) {
+                DebugSerial.printf("Scan period_us is below the %dus minimum, using %dus.\n", GOVERNOR_MIN_LEAD, GOVERNOR_MIN_LEAD);
+                governor_config.period = GOVERNOR_MIN_LEAD;
+            }
+        }
+
+        if (sconfig["phase_us"].is<uint32_t>()) {
+            governor_config.phase = sconfig["phase_us"];
+        }
+    }
   
     uint8_t pcount = 2;
     for (JsonObject pobj : doc["profiles"].as<JsonArray>()) {
-        if (pcount > 9) break;
+        if (pcount > PROFILE_MAX) break;
         profiles[pcount] = Profile();
         profiles[pcount].layout = default_layout;
         for (JsonPair kv : pobj) {
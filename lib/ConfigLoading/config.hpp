@@ -8,6 +8,8 @@
 #include <ArduinoJson.h>
 #include "inputs.hpp"
 #include "ufbdisplay.hpp"
+#include "isolation.hpp"
+#include "looptiming.hpp"
 
 #define SPI1_MISO  8
 #define SPI1_SCLK 10
@@ -16,6 +18,8 @@
 #define SDCARD_SS 12
 #define DISP_DEFAULT_ADDR  0x3C
 
-bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig &display_config);
+#define PROFILE_MAX 9
+
+bool loadProfilesFromSDCard(std::map<uint8_t, Profile> &profiles, DisplayConfig &display_config, GovernorConfig &governor_config);
 
 #endif // _CONFIG_HPP
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "isolation.hpp"
+#include <atomic>
+#include "hardware/irq.h"
+#include "hardware/structs/systick.h"
+#include "hardware/sync.h"
+
+/**
+ * Start the debug serial port.  When core 0 is isolated this has to be
+ * called from core 1 so the UART interrupt is enabled on core 1.
+ */
+void beginDebugSerial() {
+#ifdef UFB_ISOLATED_CORE0
+    Serial1.setTX(UART0_TX);
+    Serial1.setRX(UART0_RX);
+#endif
+    DebugSerial.begin(DEBUG_SERIAL_BAUD);
+}
+
+// Handshake for moving core 0's interrupts over to core 1.  The NVIC
+// enables are per core, so core 0 records which ones it had and core 1
+// switches them on once core 0 has masked them.
+static std::atomic<bool> core1_initialized = false;
+static std::atomic<bool> core0_isolated = false;
+static uint32_t core0_irqs[(NUM_IRQS + 31) / 32];
+
+/**
+ * Mask every interrupt on the calling core (core 0) and stop its SysTick so
+ * nothing can preempt the scan loop.  Waits for core 1 to call
+ * adoptCore0Interrupts() first, since until then core 1 still relies on
+ * core 0 servicing the timer (e.g. for delay() while the display starts).
+ * There's no way back: anything that needs core 0 to respond (e.g. a flash
+ * write from core 1 pausing the other core) will hang after this is called.
+ */
+void isolateCore0() {
+    while (!core1_initialized.load(std::memory_order_acquire)) {
+        tight_loop_contents();
+    }
+
+    // Each core has its own FIFO interrupt, so that one stays behind
+    for (uint irq = 0; irq < NUM_IRQS; irq++) {
+#ifdef SIO_IRQ_PROC0
+        if (irq == SIO_IRQ_PROC0) continue;
+#endif
+#ifdef SIO_IRQ_FIFO
+        if (irq == SIO_IRQ_FIFO) continue;
+#endif
+        if (irq_is_enabled(irq)) core0_irqs[irq / 32] |= 1u << (irq % 32);
+    }
+
+    save_and_disable_interrupts();
+    for (uint irq = 0; irq < NUM_IRQS; irq++) {
+        irq_set_enabled(irq, false);
+    }
+    systick_hw->csr = 0;
+
+    core0_isolated.store(true, std::memory_order_release);
+}
+
+/**
+ * Take over the interrupts core 0 had enabled (including the timer alarm
+ * behind delay() and sleep_ms()) once it has isolated itself.  Must be
+ * called from core 1 after everything it needs to start up is done, and
+ * blocks until core 0 is isolated.  The handlers themselves don't move:
+ * both cores share the vector table.  Anything that fires in between just
+ * stays pending until core 1 enables it.
+ */
+void adoptCore0Interrupts() {
+    core1_initialized.store(true, std::memory_order_release);
+    while (!core0_isolated.load(std::memory_order_acquire)) {
+        tight_loop_contents();
+    }
+
+    for (uint irq = 0; irq < NUM_IRQS; irq++) {
+        if (core0_irqs[irq / 32] & (1u << (irq % 32))) irq_set_enabled(irq, true);
+    }
+}
+
+/**
+ * Capture the register values for an SPI format and clock rate so they
+ * can be applied later with applySpiConfig().
+ * 
+ * @param spi the SPI bus, already initialized
+ * @param settings the Arduino SPI settings to capture
+ * @return the captured configuration
+ */
+SpiConfig captureSpiConfig(spi_inst_t *spi, const SPISettings &settings) {
+    const uint8_t mode = settings.getDataMode();
+    spi_set_baudrate(spi, settings.getClockFreq());
+    spi_set_format(spi, 8,
+        (mode == SPI_MODE2 || mode == SPI_MODE3) ? SPI_CPOL_1 : SPI_CPOL_0,
+        (mode == SPI_MODE1 || mode == SPI_MODE3) ? SPI_CPHA_1 : SPI_CPHA_0,
+        SPI_MSB_FIRST);
+
+    spi_hw_t *hw = spi_get_hw(spi);
+    return {hw->cr0, hw->cpsr};
+}
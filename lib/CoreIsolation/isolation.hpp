@@ -0,0 +1,48 @@
+#ifndef _ISOLATION_HPP
+#define _ISOLATION_HPP
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/spi.h"
+
+// With UFB_ISOLATED_CORE0 the USB stack is compiled out and logging goes
+// out of UART0 instead, which is started (and takes its IRQ) on core 1.
+#define UART0_TX 16
+#define UART0_RX 17
+#define DEBUG_SERIAL_BAUD 115200
+
+#ifdef UFB_ISOLATED_CORE0
+#define DebugSerial Serial1
+#define SCAN_FUNC(func) __not_in_flash_func(func)
+#else
+#define DebugSerial Serial
+#define SCAN_FUNC(func) func
+#endif
+
+
+struct SpiConfig {
+    uint32_t cr0;
+    uint32_t cpsr;
+};
+
+void beginDebugSerial();
+void isolateCore0();
+void adoptCore0Interrupts();
+SpiConfig captureSpiConfig(spi_inst_t *spi, const SPISettings &settings);
+
+/**
+ * Switch an SPI bus to a previously captured format and clock rate.  This
+ * is only a few register writes, so it can be done on every transfer.
+ * 
+ * @param spi the SPI bus
+ * @param config the captured configuration
+ */
+static inline void applySpiConfig(spi_inst_t *spi, const SpiConfig &config) {
+    spi_hw_t *hw = spi_get_hw(spi);
+    hw_clear_bits(&hw->cr1, SPI_SSPCR1_SSE_BITS);
+    hw->cpsr = config.cpsr;
+    hw->cr0 = config.cr0;
+    hw_set_bits(&hw->cr1, SPI_SSPCR1_SSE_BITS);
+}
+
+#endif // _ISOLATION_HPP
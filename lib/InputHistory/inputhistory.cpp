@@ -0,0 +1,42 @@
+#include "inputhistory.hpp"
+
+InputHistory input_history;
+
+/**
+ * Drain the event queue into the history.  Called from core 1 only.  Events
+ * that don't change the outputs (e.g. an unmapped input) are folded into
+ * the entry before them so its duration stays correct.
+ */
+void InputHistory::update() {
+    InputEvent event;
+    while (events.pop(event)) {
+        if (count && entries[newest].outputs == event.outputs) continue;
+
+        newest = (newest + 1) % HISTORY_LENGTH;
+        entries[newest] = event;
+        if (count < HISTORY_LENGTH) count++;
+    }
+}
+
+/**
+ * Get an entry from the history.
+ * 
+ * @param index the entry to get, 0 being the newest
+ * @return the history entry
+ */
+const InputEvent &InputHistory::entry(uint8_t index) const {
+    return entries[(newest + HISTORY_LENGTH - index) % HISTORY_LENGTH];
+}
+
+/**
+ * Get how long an entry in the history was held.  The newest entry is still
+ * being held, so its duration runs up to the given time.
+ * 
+ * @param index the entry to check, 0 being the newest
+ * @param now the current time in microseconds
+ * @return the duration in microseconds
+ */
+uint32_t InputHistory::duration(uint8_t index, uint32_t now) const {
+    if (index == 0) return now - entry(0).timestamp;
+    return entry(index - 1).timestamp - entry(index).timestamp;
+}
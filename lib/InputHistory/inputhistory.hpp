@@ -0,0 +1,102 @@
+#ifndef _INPUTHISTORY_HPP
+#define _INPUTHISTORY_HPP
+
+#include <Arduino.h>
+#include <atomic>
+#include "hardware/timer.h"
+
+#define HISTORY_QUEUE_SIZE 256
+#define HISTORY_LENGTH      16
+#define HISTORY_FPS         60
+
+
+struct InputEvent {
+    uint32_t outputs;
+    uint32_t timestamp;
+};
+
+/**
+ * Wait-free single-producer/single-consumer ring buffer.  Core 0 is the
+ * only producer and core 1 the only consumer, so the head and tail each
+ * have exactly one writer and plain loads/stores with acquire/release
+ * ordering are enough (the M0+ has no native read-modify-write atomics).
+ *
+ * @tparam T the type of item stored in the ring
+ * @tparam N the capacity of the ring, must be a power of two
+ */
+template <typename T, uint32_t N>
+class EventRing {
+    static_assert(N != 0 && (N & (N - 1)) == 0, "EventRing capacity must be a power of two");
+
+    public:
+        /**
+         * Push an item onto the ring.  Never blocks: if the ring is full the
+         * item is dropped and the drop counter is incremented.
+         *
+         * @param item the item to push
+         * @return whether the item was queued
+         */
+        inline bool push(const T &item) {
+            const uint32_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= N) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+            buffer[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Pop the oldest item off the ring.
+         *
+         * @param item where to store the popped item
+         * @return whether an item was available
+         */
+        inline bool pop(T &item) {
+            const uint32_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return false;
+            item = buffer[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        T buffer[N];
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+        std::atomic<uint32_t> dropped{0};
+};
+
+
+class InputHistory {
+    public:
+        /**
+         * Queue an output change for the history display.  Called from core 0
+         * only; costs a timer read and a handful of stores and never blocks.
+         *
+         * @param outputs the output data
+         */
+        inline void record(uint32_t outputs) {
+            events.push({outputs, time_us_32()});
+        }
+
+        void update();
+        const InputEvent &entry(uint8_t index) const;
+        uint32_t duration(uint8_t index, uint32_t now) const;
+
+        uint8_t size() const { return count; }
+        uint32_t dropped() const { return events.droppedCount(); }
+
+    private:
+        EventRing<InputEvent, HISTORY_QUEUE_SIZE> events;
+        InputEvent entries[HISTORY_LENGTH];
+        uint8_t newest = 0;
+        uint8_t count = 0;
+};
+
+extern InputHistory input_history;
+
+#endif // _INPUTHISTORY_HPP
@@ -1,4 +1,5 @@
 #include "inputs.hpp"
+#include "isolation.hpp"
 
 SPISettings inputSettings(SPI0_SCLK_SPEED_INPUTS, MSBFIRST, SPI_MODE2);
 SPISettings outputSettings(SPI0_SCLK_SPEED_OUTPUTS, MSBFIRST, SPI_MODE0);
@@ -20,8 +21,14 @@ void Profile::generateMask() {
     }
 
     mask = (1 << OUTPUT_TOTAL) - 1;
+    mapping_count = 0;
     for (auto const &[key, val] : profile_map) {
         mask ^= 1 << (key - 1);
+        if (mapping_count < INPUT_MAPPABLE) {
+            mapping_inputs[mapping_count] = key;
+            mapping_outputs[mapping_count] = val;
+            mapping_count++;
+        }
     }
     is_passthrough = false;
 };
@@ -32,12 +39,12 @@ void Profile::generateMask() {
  * @param data the input data
  * @return the processed output data
  */
-uint32_t Profile::processInputs(const uint32_t data) {
+uint32_t SCAN_FUNC(Profile::processInputs)(const uint32_t data) {
     if (is_passthrough) return data;
 
     uint32_t processed_data = data & mask;
-    for (auto const &[key, value] : profile_map) {
-        processed_data |= value * (data >> (key - 1) & 1);    
+    for (uint8_t i = 0; i < mapping_count; i++) {
+        processed_data |= mapping_outputs[i] * (data >> (mapping_inputs[i] - 1) & 1);
     }
     return processed_data;
 }
@@ -48,6 +55,6 @@ uint32_t Profile::processInputs(const uint32_t data) {
  * @param data the data to reverse
  * @return the reversed data
  */
-uint32_t reverseBytes(uint32_t data) {
+uint32_t SCAN_FUNC(reverseBytes)(uint32_t data) {
     return ((data & 0xFF) << 24 | (data & 0xFF00) << 8 | (data & 0xFF0000) >> 8 | (data >> 24));
 }
@@ -19,6 +19,7 @@
 #define OUTPUT_CLR 7
 
 #define OUTPUT_TOTAL 18
+#define INPUT_MAPPABLE 29
 
 
 extern SPISettings inputSettings, outputSettings;
@@ -41,6 +42,11 @@ class Profile {
         bool is_passthrough = true;
         uint32_t mask;
 
+        // Flattened copy of profile_map so processing doesn't walk the tree
+        uint8_t mapping_count = 0;
+        uint8_t mapping_inputs[INPUT_MAPPABLE];
+        uint32_t mapping_outputs[INPUT_MAPPABLE];
+
 };
 
 uint32_t reverseBytes(const uint32_t data);
@@ -0,0 +1,143 @@
+#include "looptiming.hpp"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/structs/scb.h"
+
+PeriodStats loop_stats;
+ScanGovernor scan_governor;
+GovernorConfig governor_config;
+
+/**
+ * Collect the statistics gathered since the last call and ask core 0 to
+ * start over.  Called from core 1 only.
+ * 
+ * @return the collected statistics
+ */
+PeriodReport PeriodStats::collect() {
+    PeriodReport report;
+    report.samples = samples.load(std::memory_order_acquire);
+    report.min_period = min_period.load(std::memory_order_relaxed);
+    report.max_period = max_period.load(std::memory_order_relaxed);
+    report.total = total.load(std::memory_order_relaxed);
+    reset_requested.store(true, std::memory_order_release);
+    return report;
+}
+
+/**
+ * Print a period report in microseconds.
+ * 
+ * @param out where to print the report
+ * @param name the name of what was measured
+ * @param report the report to print
+ */
+void printPeriodReport(Print &out, const char *name, const PeriodReport &report) {
+    if (report.samples < 2) {
+        out.printf("%s: not enough samples\n", name);
+        return;
+    }
+    out.printf("%s: samples=%lu min=%luus max=%luus mean=%.2fus jitter=%luus\n",
+        name, report.samples, report.min_period, report.max_period,
+        (double)report.total / (report.samples - 1),
+        report.max_period - report.min_period);
+}
+
+/**
+ * Start pacing the scan loop.  The alarm interrupt is left disabled in the
+ * NVIC and core 0 waits for it with WFE (woken by SEVONPEND), so no handler
+ * is needed and it works with core 0's interrupts masked.  The phase is
+ * relative to the Pico's own timer (zero at boot), not to anything on the
+ * UFB, so the schedule will drift against the UFB's USB polling.  The timer
+ * only has microsecond resolution, so that's as fine as the phase can be set.
+ * 
+ * @param config the period and phase to sample at
+ */
+void ScanGovernor::begin(const GovernorConfig &config) {
+    if (config.period == 0) return;
+
+    period = config.period;
+    phase = config.phase % config.period;
+
+    alarm = hardware_alarm_claim_unused(true);
+    alarm_mask = 1u << alarm;
+#ifdef TIMER0_IRQ_0
+    irq = TIMER0_IRQ_0 + alarm;
+#else
+    irq = TIMER_IRQ_0 + alarm;
+#endif
+
+    hw_set_bits(&timer_hw->inte, alarm_mask);
+    hw_set_bits(&scb_hw->scr, SCR_SEVONPEND);
+
+    // Start from the last sample time on the schedule at or before now (it
+    // may be before zero if the phase hasn't come round yet, which the
+    // signed comparisons in alignedAfter() handle).
+    const uint64_t now = timeUs64();
+    next = now >= phase ? now - (now - phase) % period : phase - period;
+    next = alignedAfter(now) - period;
+    started.store(true, std::memory_order_release);
+}
+
+/**
+ * Get the first sample time on the schedule that's far enough after the
+ * given time to arm the alarm for.  This steps on from the last target
+ * rather than dividing, so the scan path doesn't call the 64-bit division
+ * helper in flash.  It works on the 64-bit timer so the schedule doesn't
+ * shift when the low 32 bits wrap.
+ * 
+ * @param now the current time in microseconds
+ * @return the next sample time in microseconds
+ */
+uint64_t SCAN_FUNC(ScanGovernor::alignedAfter)(uint64_t now) const {
+    uint64_t target = next;
+    while ((int64_t)(target - now) < GOVERNOR_MIN_LEAD) target += period;
+    return target;
+}
+
+/**
+ * Sleep until the next sample time.  If the last scan ran past it, the
+ * overrun is counted and the schedule skips ahead to the next slot.
+ */
+void SCAN_FUNC(ScanGovernor::wait)() {
+    next += period;
+    const uint64_t now = timeUs64();
+    if ((int64_t)(next - now) < GOVERNOR_MIN_LEAD) {
+        countOverrun();
+        next = alignedAfter(now);
+    }
+
+    // The alarm only fires when the timer matches the target exactly, so if
+    // an interrupt or a flash cache miss held us up past the target while
+    // arming it, disarm and move on rather than waiting for the timer to wrap.
+    // It may have fired anyway, so clear the pending interrupt too: if it's
+    // left pending the next alarm can't raise a new event to wake us.
+    while (true) {
+        timer_hw->alarm[alarm] = (uint32_t)next;
+        if ((int64_t)(next - timeUs64()) > 0) break;
+
+        timer_hw->armed = alarm_mask;
+        timer_hw->intr = alarm_mask;
+        irq_clear(irq);
+        countOverrun();
+        next = alignedAfter(timeUs64());
+    }
+    while (timer_hw->armed & alarm_mask) __wfe();
+
+    // Clear the timer first so the NVIC doesn't go straight back to pending
+    timer_hw->intr = alarm_mask;
+    irq_clear(irq);
+
+    stats.sample(time_us_32());
+}
+
+/**
+ * Print the achieved sample period since the last report and the number of
+ * overruns since boot.  Called from core 1 only.
+ * 
+ * @param out where to print the report
+ */
+void ScanGovernor::report(Print &out) {
+    printPeriodReport(out, "Scan governor period", stats.collect());
+    out.printf("Scan governor: target=%luus phase=%luus overruns=%lu\n",
+        period, phase, overruns.load(std::memory_order_relaxed));
+}
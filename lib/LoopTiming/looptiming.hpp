@@ -0,0 +1,130 @@
+#ifndef _LOOPTIMING_HPP
+#define _LOOPTIMING_HPP
+
+#include <Arduino.h>
+#include <atomic>
+#include "isolation.hpp"
+#include "hardware/timer.h"
+
+#define LOOP_STATS_INTERVAL 1000
+
+#define GOVERNOR_MIN_LEAD 2   // microseconds needed to safely arm the alarm
+#define SCR_SEVONPEND (1u << 4)
+
+
+/**
+ * Read the 64-bit microsecond timer.  Reads the raw registers (re-reading
+ * the high word if it rolled over) so it's inlined, safe from either core
+ * and can't be preempted into returning a torn value.
+ * 
+ * @return the time since boot in microseconds
+ */
+static inline uint64_t timeUs64() {
+    uint32_t hi = timer_hw->timerawh;
+    uint32_t lo;
+    while (true) {
+        lo = timer_hw->timerawl;
+        const uint32_t next_hi = timer_hw->timerawh;
+        if (hi == next_hi) break;
+        hi = next_hi;
+    }
+    return ((uint64_t)hi << 32) | lo;
+}
+
+struct PeriodReport {
+    uint32_t samples;
+    uint32_t min_period;
+    uint32_t max_period;
+    uint32_t total;
+};
+
+/**
+ * Tracks the period between samples taken on core 0 so core 1 can report
+ * it.  Core 0 is the only writer of the statistics; core 1 asks for them
+ * to be cleared by setting a flag that core 0 picks up on its next sample.
+ */
+class PeriodStats {
+    public:
+        /**
+         * Record a sample.  Called from core 0 only.
+         * 
+         * @param now the current time in microseconds
+         */
+        inline void sample(uint32_t now) {
+            if (reset_requested.load(std::memory_order_acquire)) {
+                samples.store(0, std::memory_order_relaxed);
+                reset_requested.store(false, std::memory_order_relaxed);
+            }
+
+            const uint32_t count = samples.load(std::memory_order_relaxed);
+            if (count == 0) {
+                min_period.store(UINT32_MAX, std::memory_order_relaxed);
+                max_period.store(0, std::memory_order_relaxed);
+                total.store(0, std::memory_order_relaxed);
+            } else {
+                const uint32_t period = now - last;
+                if (period < min_period.load(std::memory_order_relaxed))
+                    min_period.store(period, std::memory_order_relaxed);
+                if (period > max_period.load(std::memory_order_relaxed))
+                    max_period.store(period, std::memory_order_relaxed);
+                total.store(total.load(std::memory_order_relaxed) + period, std::memory_order_relaxed);
+            }
+            last = now;
+            samples.store(count + 1, std::memory_order_release);
+        }
+
+        PeriodReport collect();
+
+    private:
+        uint32_t last = 0;
+        std::atomic<bool> reset_requested{false};
+        std::atomic<uint32_t> samples{0};
+        std::atomic<uint32_t> min_period{0};
+        std::atomic<uint32_t> max_period{0};
+        std::atomic<uint32_t> total{0};
+};
+
+struct GovernorConfig {
+    uint32_t period = 0; // microseconds, 0 lets the scan loop free-run
+    uint32_t phase = 0;  // microseconds, relative to the Pico's timer
+};
+
+/**
+ * Paces the scan loop off a hardware timer alarm so samples are taken on a
+ * fixed schedule (every period, offset by phase, on the Pico's 64-bit
+ * timer) and core 0 sleeps in between.  Only core 0 calls begin() and wait().
+ */
+class ScanGovernor {
+    public:
+        void begin(const GovernorConfig &config);
+        void wait();
+        void report(Print &out);
+
+        bool enabled() const { return started.load(std::memory_order_acquire); }
+
+    private:
+        uint64_t alignedAfter(uint64_t now) const;
+
+        inline void countOverrun() {
+            overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        uint32_t period = 0;
+        uint32_t phase = 0;
+        uint64_t next = 0;
+        uint alarm = 0;
+        uint32_t alarm_mask = 0;
+        uint irq = 0;
+
+        PeriodStats stats;
+        std::atomic<uint32_t> overruns{0};
+        std::atomic<bool> started{false}; // publishes the fields above to core 1
+};
+
+extern PeriodStats loop_stats;
+extern ScanGovernor scan_governor;
+extern GovernorConfig governor_config;
+
+void printPeriodReport(Print &out, const char *name, const PeriodReport &report);
+
+#endif // _LOOPTIMING_HPP
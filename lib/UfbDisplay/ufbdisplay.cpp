@@ -4,6 +4,10 @@ U8G2 display;
 uint8_t input_width = 8;
 DisplayConfig display_config;
 
+// Attack buttons shown in the input history, in fightstick order
+const uint8_t history_buttons[] = {8, 7, 6, 5, 4, 3, 2, 1};
+const char *history_labels[] = {"1P", "2P", "3P", "4P", "1K", "2K", "3K", "4K"};
+
 /**
  * Init display
  * 
@@ -239,6 +243,74 @@ void drawInputs(uint8_t line, uint32_t data) {
     }
 }
 
+/**
+ * Draw the input history, newest entry first.  Each row shows how long the
+ * entry was held (frames and milliseconds), the direction in numpad notation
+ * and the attack buttons held, with a trailing '+' if any other output was.
+ * 
+ * @param line the line to start drawing the history on
+ * @param rows the number of rows to draw
+ */
+void drawHistory(uint8_t line, uint8_t rows) {
+    const uint32_t now = time_us_32();
+    char row[40];
+
+    display.setFont(u8g2_font_tom_thumb_4x6_tr);
+    for (uint8_t i = 0; i < rows && i < input_history.size(); i++) {
+        const uint32_t data = input_history.entry(i).outputs;
+        const uint32_t held = input_history.duration(i, now);
+
+        const uint32_t frames = ((uint64_t)held * HISTORY_FPS + 500000) / 1000000;
+        const uint32_t tenths = min(held / 100, (uint32_t)99999);
+        const char direction = '5'
+            + readInput(data, 13) - readInput(data, 12)
+            + 3 * (readInput(data, 15) - readInput(data, 14));
+
+        char buttons[20];
+        int buttons_len = 0;
+        for (uint8_t b = 0; b < sizeof(history_buttons); b++) {
+            if (readInput(data, history_buttons[b])) {
+                buttons_len += snprintf(buttons + buttons_len, sizeof(buttons) - buttons_len, "%s", history_labels[b]);
+            }
+        }
+        if (data & ((0b111 << 8) | (0b111 << 15))) {
+            buttons_len += snprintf(buttons + buttons_len, sizeof(buttons) - buttons_len, "+");
+        }
+
+        // The timing fields and direction take 16 characters with the space
+        // after them.  With all 8 buttons and the + held that's one too many
+        // for the display, so drop the space when the row won't fit.
+        const bool spaced = 16 + buttons_len <= DISP_WIDTH / HISTORY_CHAR_WIDTH;
+        snprintf(row, sizeof(row), "%3lu%c %4lu.%lums %c%s%s",
+            min(frames, (uint32_t)999), frames > 999 ? '+' : 'f',
+            tenths / 10, tenths % 10, direction, spaced ? " " : "", buttons);
+
+        display.setCursor(0, line + (i + 1) * HISTORY_ROW_HEIGHT - 1);
+        display.print(row);
+    }
+    display.setFont(u8g2_font_spleen5x8_mr);
+}
+
+/**
+ * Draw the profile number and name.
+ * 
+ * @param line the line on the display to draw the profile on
+ * @param profile the profile in use
+ * @param profile_num the number of the profile in use
+ */
+void drawProfile(uint8_t line, Profile &profile, uint8_t profile_num) {
+    display.drawRBox(0, line, 8, 8, 1);
+    display.setFontMode(1);
+    display.setFont(u8g2_font_squeezed_b6_tn);
+    display.setDrawColor(0);
+    display.setCursor(2, line + 7);
+    display.print(profile_num);
+    display.setDrawColor(1);
+    display.setCursor(12, line + 7);
+    display.setFont(u8g2_font_spleen5x8_mr);
+    display.println(profile.profile_name);
+}
+
 /**
  * Draw the screen with all of the inputs and outputs.
  * 
@@ -267,16 +339,7 @@ void drawScreen128X64(uint32_t input_data, uint32_t output_data, Profile &profil
     drawInputs(8, input_data);
 
     // Draw lower-half (outputs)
-    display.drawRBox(0, 30, 8, 8, 1);
-    display.setFontMode(1);
-    display.setFont(u8g2_font_squeezed_b6_tn);
-    display.setDrawColor(0);
-    display.setCursor(2, 37);
-    display.print(profile_num);
-    display.setDrawColor(1);
-    display.setCursor(12, 37);
-    display.setFont(u8g2_font_spleen5x8_mr);
-    display.println(profile.profile_name);
+    drawProfile(30, profile, profile_num);
     drawOutputs(40, output_data, (DisplayOptions)profile.layout);
 
     display.sendBuffer();
@@ -295,26 +358,69 @@ void drawScreen128X32(uint32_t input_data, uint32_t output_data, Profile &profil
     display.clearBuffer();
 
     // Draw lower-half (outputs)
-    display.drawRBox(0, 0, 8, 8, 1);
-    display.setFontMode(1);
-    display.setFont(u8g2_font_squeezed_b6_tn);
-    display.setDrawColor(0);
-    display.setCursor(2, 7);
-    display.print(profile_num);
-    display.setDrawColor(1);
-    display.setCursor(12, 7);
-    display.setFont(u8g2_font_spleen5x8_mr);
-    display.println(profile.profile_name);
+    drawProfile(0, profile, profile_num);
     drawOutputs(10, output_data, (DisplayOptions)profile.layout);
 
     display.sendBuffer();
 }
 
 /**
+ * Draw the screen with the profile and the scrolling input history.  The
+ * unlock indicator and any events dropped by the history queue are shown
+ * at the top-right, and the profile name is clipped to stay clear of them.
+ * 
+ * @param input_data the input data
+ * @param profile the profile in use
+ * @param profile_num the number of the profile in use
+ * @param height the height of the display
+ */
+void drawScreenHistory(uint32_t input_data, Profile &profile, uint8_t profile_num, uint8_t height) {
+    display.clearBuffer();
+
+    uint8_t badge_x = DISP_WIDTH;
+    display.setFont(u8g2_font_tom_thumb_4x6_tr);
+    if (readInput(input_data, 30)) {
+        badge_x = 100;
+        display.drawRBox(badge_x, 0, 27, 7, 1);
+        display.setDrawColor(0);
+        display.setCursor(badge_x + 2, 6);
+        display.print("Unlock");
+        display.setDrawColor(1);
+    }
+
+    const uint32_t dropped = input_history.dropped();
+    if (dropped) {
+        badge_x -= 32;
+        display.drawRBox(badge_x, 0, 31, 7, 1);
+        display.setDrawColor(0);
+        display.setCursor(badge_x + 2, 6);
+        display.print("D:");
+        display.print(min(dropped, (uint32_t)99999));
+        display.setDrawColor(1);
+    }
+    display.setFont(u8g2_font_spleen5x8_mr);
+
+    display.setClipWindow(0, 0, badge_x - 1, 8);
+    drawProfile(0, profile, profile_num);
+    display.setMaxClipWindow();
+
+    drawHistory(9, (height - 9) / HISTORY_ROW_HEIGHT);
+
+    display.sendBuffer();
+}
+
+/**
+ * Draw the screen using the layout of the profile in use.
  * 
+ * @param input_data the input data
+ * @param output_data the output data
+ * @param profile the profile in use
+ * @param profile_num the number of the profile in use
  */
 void drawScreen(uint32_t input_data, uint32_t output_data, Profile &profile, uint8_t profile_num) {
-    if (display_config.resolution == "128x32") {
+    if ((DisplayOptions)profile.layout == DisplayOptions::HISTORY) {
+        drawScreenHistory(input_data, profile, profile_num, display_config.resolution == "128x32" ? 32 : DISP_HEIGHT);
+    } else if (display_config.resolution == "128x32") {
         drawScreen128X32(input_data, output_data, profile, profile_num);
     } else {
         drawScreen128X64(input_data, output_data, profile, profile_num);
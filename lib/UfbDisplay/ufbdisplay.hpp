@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "inputs.hpp"
+#include "inputhistory.hpp"
 #include <U8g2lib.h>
 #include <atomic>
 
@@ -13,10 +14,14 @@
 #define DISP_WIDTH  128
 #define DISP_HEIGHT  64
 
+#define HISTORY_ROW_HEIGHT 6
+#define HISTORY_CHAR_WIDTH 4
+
 enum class DisplayOptions {
     FIGHTSTICK,
     HITBOX,
-    CONTROLLER
+    CONTROLLER,
+    HISTORY
 };
 
 struct DisplayConfig {
@@ -35,6 +40,7 @@ void drawCircle(uint8_t x, uint8_t y, bool enabled);
 bool readInput(uint32_t data, uint8_t input);
 void drawOutputs(uint8_t line, uint32_t data, DisplayOptions display_type);
 void drawInputs(uint8_t line, uint32_t data);
+void drawHistory(uint8_t line, uint8_t rows);
 
 void drawScreen(uint32_t input_data, uint32_t output_data, Profile &profile_name, uint8_t profile_num);
 
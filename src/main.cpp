@@ -3,17 +3,133 @@
 #include <ufbdisplay.hpp>
 #include <inputs.hpp>
 #include <config.hpp>
+#include <inputhistory.hpp>
+#include <isolation.hpp>
+#include <looptiming.hpp>
+#include <calibration.hpp>
 
 #define UFB_ENABLE 22
 #define BOOT_LED 25
 
+#define PROFILE_DEBOUNCE_US 200000
+
 uint32_t input_buffer, output_buffer;
-uint32_t profile_debounce = 0;
+uint64_t profile_debounce = 0;
 
 std::map<uint8_t, Profile> profiles;
 std::atomic<uint32_t> input_data, output_data;
 std::atomic<uint8_t> current_profile;
 
+// Fixed lookup of profiles by number (unused slots are null) so neither
+// core has to search the profile map once the config is loaded.
+Profile *profile_table[PROFILE_MAX + 2] = {};
+
+#ifdef UFB_ISOLATED_CORE0
+std::atomic<bool> core0_ready = false;
+SpiConfig input_spi, output_spi;
+#endif
+
+
+/**
+ * Fill in the profile lookup table.  Must be called by whichever core loads
+ * the config, before config_loaded is set.
+ */
+void buildProfileTable() {
+    for (auto &[num, profile] : profiles) {
+        if (num <= PROFILE_MAX) profile_table[num] = &profile;
+    }
+}
+
+/**
+ * Latch and read all of the inputs (4 bytes) into the input buffer.
+ */
+void SCAN_FUNC(readInputs)() {
+#ifdef UFB_ISOLATED_CORE0
+    applySpiConfig(spi0, input_spi);
+    gpio_put(INPUT_CE, LOW);
+    gpio_put(INPUT_LATCH, LOW);
+    busy_wait_at_least_cycles(8);
+    gpio_put(INPUT_LATCH, HIGH);
+
+    spi_read_blocking(spi0, 0, (uint8_t *)&input_buffer, 4);
+
+    gpio_put(INPUT_CE, HIGH);
+#else
+    SPI.beginTransaction(inputSettings);
+    digitalWrite(INPUT_CE, LOW);
+    digitalWrite(INPUT_LATCH, LOW);
+    digitalWrite(INPUT_LATCH, HIGH);
+
+    SPI.transfer(&input_buffer, 4);
+
+    digitalWrite(INPUT_CE, HIGH);
+    SPI.endTransaction();
+#endif
+}
+
+/**
+ * Write all of the outputs (3 bytes) from the output buffer.
+ */
+void SCAN_FUNC(writeOutputs)() {
+#ifdef UFB_ISOLATED_CORE0
+    applySpiConfig(spi0, output_spi);
+    gpio_put(OUTPUT_CE, LOW);
+    gpio_put(OUTPUT_SS, LOW);
+
+    spi_write_blocking(spi0, (uint8_t *)&output_buffer, 3);
+
+    gpio_put(OUTPUT_SS, HIGH);
+#else
+    digitalWrite(OUTPUT_CE, LOW);
+    digitalWrite(OUTPUT_SS, LOW);
+
+    SPI.beginTransaction(outputSettings);
+    SPI.transfer(&output_buffer, 3);
+    SPI.endTransaction();
+
+    digitalWrite(OUTPUT_SS, HIGH);
+#endif
+}
+
+/**
+ * Read the inputs and, if they changed, process them and write the outputs.
+ */
+void SCAN_FUNC(scanInputs)() {
+#ifdef UFB_LOOP_STATS
+    loop_stats.sample(time_us_32());
+#endif
+
+    readInputs();
+
+    // Short circuit processing if the inputs haven't changed
+    if (input_buffer == input_data.load()) return;
+
+    // Switch profiles based on 31/32
+    uint8_t selected_profile = current_profile.load();
+    if (input_buffer & (1 << 29) && timeUs64() > profile_debounce) {
+        if (input_buffer & (1 << 30)) {
+            if (profile_table[selected_profile - 1]) {
+                current_profile.store(selected_profile - 1);
+                profile_debounce = timeUs64() + PROFILE_DEBOUNCE_US;
+            }
+        } else if (input_buffer & (1 << 31)) {
+            if (profile_table[selected_profile + 1]) {
+                current_profile.store(selected_profile + 1);
+                profile_debounce = timeUs64() + PROFILE_DEBOUNCE_US;
+            }
+        }
+    }
+
+    // Store and process input data
+    input_data.store(input_buffer);
+    output_data.store(profile_table[current_profile.load()]->processInputs(input_buffer));
+    output_buffer = reverseBytes(output_data.load()) >> 8;
+
+    writeOutputs();
+
+    // Queue the change for the input history display
+    input_history.record(output_data.load());
+}
 
 void setup() {
     pinMode(UFB_ENABLE, OUTPUT);
@@ -27,12 +143,13 @@ void setup() {
     input_data.store(0);
     output_data.store(0);
 
-    Serial.begin(9600);
+    // In the isolated builds the debug UART isn't started (by core 1) until
+    // after calibration, which is covered by the report printed from there.
+#ifndef UFB_ISOLATED_CORE0
+    beginDebugSerial();
 
-    Serial.println("Loading config file...");
-    display_config.config_loaded.store(loadProfilesFromSDCard(profiles, display_config));
-
-    Serial.println("Starting SPI busses...");
+    DebugSerial.println("Starting SPI busses...");
+#endif
 
     // Configure the SPI0 bus for reading/writing data
     SPI.setRX(SPI0_MISO);
@@ -53,98 +170,112 @@ void setup() {
     digitalWrite(OUTPUT_CE, HIGH);
     digitalWrite(OUTPUT_CLR, HIGH);
 
-    Serial.println("Starting controller...");
+    // Holding PE, P- and P+ at boot calibrates the clocks.  The buttons are
+    // checked at the boot clock and skip the saved setting, so a saved clock
+    // that turns out to be unstable can always be replaced.  Either way the
+    // clocks have to be set before the display or debug UART are started on
+    // core 1.
+    if (calibrationRequested()) {
+#ifndef UFB_ISOLATED_CORE0
+        DebugSerial.println("Calibrating clocks...");
+#endif
+        if (runCalibration()) saveCalibration();
+    } else {
+        loadCalibration();
+    }
+    applyCalibration();
+
+#ifdef UFB_ISOLATED_CORE0
+    spi_init(spi0, inputSettings.getClockFreq());
+    input_spi = captureSpiConfig(spi0, inputSettings);
+    output_spi = captureSpiConfig(spi0, outputSettings);
+
+    // The SD card, display and debug UART all belong to core 1 in this mode,
+    // so hand the config loading over and wait for it to finish.
+    core0_ready.store(true);
+    do { delay(1); } while (!display_config.config_loaded.load());
+#else
+    DebugSerial.println("Loading config file...");
+    const bool loaded = loadProfilesFromSDCard(profiles, display_config, governor_config);
+    buildProfileTable();
+    display_config.config_loaded.store(loaded);
+#endif
+
+    DebugSerial.println("Starting controller...");
 
     // Do an initial read of the inputs...
-    SPI.beginTransaction(inputSettings);
-    digitalWrite(INPUT_CE, LOW);
-    digitalWrite(INPUT_LATCH, LOW);
-    digitalWrite(INPUT_LATCH, HIGH);
-
-    SPI.transfer(&input_buffer, 4);
-
-    digitalWrite(INPUT_CE, HIGH);
-    SPI.endTransaction();
+    readInputs();
 
     // Process the inputs
     input_data.store(input_buffer);
-    output_data.store(profiles[current_profile.load()].processInputs(input_buffer));
+    output_data.store(profile_table[current_profile.load()]->processInputs(input_buffer));
     output_buffer = reverseBytes(output_data.load()) >> 8;
 
-    // Write all outputs (3 bytes)
-    digitalWrite(OUTPUT_CE, LOW);
-    digitalWrite(OUTPUT_SS, LOW);
-
-    SPI.beginTransaction(outputSettings);
-    SPI.transfer(&output_buffer, 3);
-    SPI.endTransaction();
-    
-    digitalWrite(OUTPUT_SS, HIGH);
+    writeOutputs();
+    input_history.record(output_data.load());
 
     // Enable the power rail on the UFB.  Need to delay this after the
     // outputs have been set on the adapter board.
     digitalWrite(UFB_ENABLE, HIGH);
     digitalWrite(BOOT_LED, HIGH);
+
+    scan_governor.begin(governor_config);
 }
 
 void loop(){
-    // Read all inputs (4 bytes)
-    SPI.beginTransaction(inputSettings);
-    digitalWrite(INPUT_CE, LOW);
-    digitalWrite(INPUT_LATCH, LOW);
-    digitalWrite(INPUT_LATCH, HIGH);
-
-    SPI.transfer(&input_buffer, 4);
-
-    digitalWrite(INPUT_CE, HIGH);
-    SPI.endTransaction();
-
-    // Short circuit processing if the inputs haven't changed
-    if (input_buffer == input_data.load()) return;
-
-    // Switch profiles based on 31/32
-    uint8_t selected_profile = current_profile.load(); 
-    if (input_buffer & (1 << 29) && millis() > profile_debounce) {
-        if (input_buffer & (1 << 30)) {
-            if (profiles.count(selected_profile - 1)) {
-                current_profile--;
-                profile_debounce = millis() + 200;
-            }
-        } else if (input_buffer & (1 << 31)) {
-            if (profiles.count(selected_profile + 1)) {
-                current_profile++;
-                profile_debounce = millis() + 200;
-            }
-        }
+#ifdef UFB_ISOLATED_CORE0
+    // Never hand control back to the framework: once core 1 has finished
+    // starting up, core 0 does nothing but scan with every interrupt masked.
+    isolateCore0();
+    while (true) {
+        if (scan_governor.enabled()) scan_governor.wait();
+        scanInputs();
     }
-
-    // Store and process input data
-    input_data.store(input_buffer);
-    output_data.store(profiles[current_profile.load()].processInputs(input_buffer));
-    output_buffer = reverseBytes(output_data.load()) >> 8;
-
-    // Write all outputs (3 bytes)
-    digitalWrite(OUTPUT_CE, LOW);
-    digitalWrite(OUTPUT_SS, LOW);
-
-    SPI.beginTransaction(outputSettings);
-    SPI.transfer(&output_buffer, 3);
-    SPI.endTransaction();
-    
-    digitalWrite(OUTPUT_SS, HIGH);
+#else
+    if (scan_governor.enabled()) scan_governor.wait();
+    scanInputs();
+#endif
 }
 
 void setup1() {
+#ifdef UFB_ISOLATED_CORE0
+    do { delay(1); } while (!core0_ready.load());
+    beginDebugSerial();
+
+    DebugSerial.println("Loading config file...");
+    const bool loaded = loadProfilesFromSDCard(profiles, display_config, governor_config);
+    buildProfileTable();
+    display_config.config_loaded.store(loaded);
+#else
     do { delay(10); } while (!display_config.config_loaded.load());
+#endif
+    printCalibrationReport(DebugSerial);
     initDisplay(display_config);
+
+#ifdef UFB_ISOLATED_CORE0
+    // Core 0 isolates itself once this is reached; from then on the timer
+    // and any other interrupts it had are serviced here.
+    adoptCore0Interrupts();
+#endif
 }
 
 uint32_t display_data = 0xFFFFFFFF;
+uint32_t stats_reported = 0;
 
 void loop1() {
     // if (display_data == input_data.load()) return;
     // display_data = input_data.load();
 
-    Profile &cprofile = profiles[current_profile.load()];
-    drawScreen(input_data.load(), output_data.load(), cprofile, current_profile.load());
+    if (millis() - stats_reported >= LOOP_STATS_INTERVAL) {
+        stats_reported = millis();
+#ifdef UFB_LOOP_STATS
+        printPeriodReport(DebugSerial, "Scan loop period", loop_stats.collect());
+#endif
+        if (scan_governor.enabled()) scan_governor.report(DebugSerial);
+    }
+
+    input_history.update();
+
+    const uint8_t profile_num = current_profile.load();
+    drawScreen(input_data.load(), output_data.load(), *profile_table[profile_num], profile_num);
 }